@@ -0,0 +1,166 @@
+// Copying just some of the CAF branches into a new, local file (a "skim").
+// Shared by SkimCAF.C and BranchIO.C.
+// If your own Vars or Cuts read something else, add it to kExerciseBranches.
+
+#pragma once
+
+// These files come from the ROOT data analysis package
+#include "TChain.h" // Lets us read lots of files as though they were one tree
+#include "TFile.h" // A ROOT data file
+#include "TTree.h" // The CAF records are stored as entries in a TTree
+#include "TBranch.h" // One variable (column) in the tree
+#include "TLeaf.h" // The type of a branch
+
+// Standard C++ library
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Every branch read by the exercises, plus the ones the standard CAFAna
+// cuts (kIsNumuCC, kIsAntiNu, kIsBeamNue) and kTrueEnergy use.
+// BranchIO.C can work this out for you from the Vars and Cuts themselves.
+const std::vector<std::string> kExerciseBranches = {
+  "run", "subrun", "event", "isFD", "isFHC",
+  "isCC", "nuPDG", "nuPDGunosc", "mode", "Ev",
+  "LepPDG", "LepE", "eP",
+  "Elep_reco", "eRecoP", "Ev_reco", "theta_reco",
+  "nP", "nN", "nipip", "nipim", "nipi0",
+  "nikp", "nikm", "nik0", "niem", "nNucleus"
+};
+
+// The one-letter ROOT type code for a simple number branch, or 0 if it isn't one
+inline char LeafTypeCode(TBranch* br)
+{
+  if(br->GetListOfLeaves()->GetEntries() != 1) return 0;
+  TLeaf* leaf = (TLeaf*)br->GetListOfLeaves()->At(0);
+  if(leaf->GetLen() != 1) return 0;
+  const std::map<std::string, char> codes = {
+    {"Char_t", 'B'}, {"UChar_t", 'b'}, {"Short_t", 'S'}, {"UShort_t", 's'},
+    {"Int_t", 'I'}, {"UInt_t", 'i'}, {"Long64_t", 'L'}, {"ULong64_t", 'l'},
+    {"Float_t", 'F'}, {"Double_t", 'D'}, {"Bool_t", 'O'}
+  };
+  auto it = codes.find(leaf->GetTypeName());
+  return it == codes.end() ? 0 : it->second;
+}
+
+// Copy the chosen branches of the records in files into one new file, outName.
+// The other branches are left out, unless zeroOthers is set: then every other
+// (simple number) branch is still there, but it's always zero. That's only for
+// a loader that won't open files with branches missing - anything that reads
+// one of those branches gets 0, with no warning.
+inline void SkimFiles(const std::vector<std::string>& files,
+                      const std::string& outName,
+                      const std::vector<std::string>& branches,
+                      bool zeroOthers = false)
+{
+  TChain chain("cafTree");
+  TChain metaChain("meta");
+  for(const std::string& f: files){
+    chain.Add(f.c_str());
+    metaChain.Add(f.c_str());
+  }
+  chain.LoadTree(0);
+
+  // Switch everything off, then switch back on only what we want to keep.
+  // Branches that are switched off aren't read or decompressed at all.
+  chain.SetBranchStatus("*", false);
+  for(const std::string& b: branches){
+    if(!chain.GetBranch(b.c_str())){
+      std::cerr << "Warning: no branch called " << b << " in the input, skipping it" << std::endl;
+      continue;
+    }
+    chain.SetBranchStatus(b.c_str(), true);
+  }
+
+  // Compression level 0: the skim is small, and it's quicker to read it back if
+  // nothing needs decompressing. Big baskets keep each branch's values together.
+  TFile fout(outName.c_str(), "RECREATE", "", 0);
+  TTree* skim = chain.CloneTree(0);
+  skim->SetBasketSize("*", 1 << 20);
+
+  // The zeros compress down to almost nothing, so those branches are compressed
+  Long64_t zero = 0; // All the bits are 0, so it's 0 whatever the type
+  if(zeroOthers){
+    for(TObject* obj: *chain.GetListOfBranches()){
+      TBranch* br = (TBranch*)obj;
+      const std::string name = br->GetName();
+      if(std::find(branches.begin(), branches.end(), name) != branches.end()) continue;
+      const char code = LeafTypeCode(br);
+      if(!code){
+        std::cerr << "Warning: can't fill " << name << " with zeros, leaving it out" << std::endl;
+        continue;
+      }
+      TBranch* zbr = skim->Branch(name.c_str(), &zero, (name + "/" + code).c_str());
+      zbr->SetCompressionLevel(1);
+    }
+  }
+
+  const long nRecords = chain.GetEntries();
+  for(long i = 0; i < nRecords; ++i){
+    chain.GetEntry(i);
+    skim->Fill();
+  }
+
+  // The exposure has to come along too, or ToTH1(pot, ...) can't scale the spectra.
+  // Add up the POT from every input file into a single meta entry.
+  double pot = 0, totPOT = 0;
+  metaChain.SetBranchStatus("*", false);
+  metaChain.SetBranchStatus("pot", true);
+  metaChain.SetBranchAddress("pot", &pot);
+  for(long i = 0; i < metaChain.GetEntries(); ++i){
+    metaChain.GetEntry(i);
+    totPOT += pot;
+  }
+  fout.cd();
+  TTree* meta = new TTree("meta", "meta");
+  meta->Branch("pot", &totPOT);
+  meta->Fill();
+
+  fout.Write();
+  fout.Close();
+
+  std::cout << "Skimmed " << nRecords << " records (" << totPOT << " POT) from "
+            << files.size() << " files into " << outName << std::endl;
+}
+
+// Expand a wildcard into the list of files, the same way TChain does
+inline std::vector<std::string> ExpandWildcard(const std::string& wildcard)
+{
+  TChain files("cafTree");
+  files.Add(wildcard.c_str());
+  std::vector<std::string> fnames;
+  for(TObject* obj: *files.GetListOfFiles()) fnames.push_back(obj->GetTitle());
+  return fnames;
+}
+
+// Skim all the files in fnames, either into outName, or (if filesPerSkim is
+// more than zero) one skim for each filesPerSkim files, numbered _000, _001...
+inline void SkimInGroups(const std::vector<std::string>& fnames,
+                         const std::string& outName,
+                         int filesPerSkim,
+                         const std::vector<std::string>& branches,
+                         bool zeroOthers = false)
+{
+  if(filesPerSkim <= 0){
+    SkimFiles(fnames, outName, branches, zeroOthers);
+    return;
+  }
+
+  // skim.root -> skim_000.root, skim_001.root, ...
+  std::string stem = outName, ext = "";
+  const size_t dot = outName.rfind(".root");
+  if(dot != std::string::npos){
+    stem = outName.substr(0, dot);
+    ext = outName.substr(dot);
+  }
+  for(size_t first = 0; first < fnames.size(); first += filesPerSkim){
+    const size_t last = std::min(fnames.size(), first + filesPerSkim);
+    char num[16];
+    snprintf(num, sizeof(num), "_%03zu", first / filesPerSkim);
+    SkimFiles(std::vector<std::string>(fnames.begin() + first, fnames.begin() + last),
+              stem + num + ext, branches, zeroOthers);
+  }
+}
@@ -0,0 +1,133 @@
+// Some helpers shared by the exercise macros.
+// You don't need to look in here to do the exercises!
+
+#pragma once
+
+// These are standard header files from the CAFAna analysis tool
+#include "CAFAna/Core/Spectrum.h"
+#include "CAFAna/Core/Binning.h"
+#include "CAFAna/Core/HistAxis.h"
+#include "CAFAna/Core/Utilities.h" // For UniqueName()
+#include "CAFAna/Core/Var.h"
+
+#include "StandardRecord/SRProxy.h" // A wrapper for the CAF format
+
+// These files come from the ROOT data analysis package
+#include "TFile.h" // A ROOT data file
+#include "TH1.h" // 1-dimensional histogram
+#include "TH2.h" // 2-dimensional histogram
+#include "THStack.h" // Stacked histograms
+
+// Standard C++ library
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The four input CAF samples, by name.
+// Environment variables and wildcards work, as do SAM datasets
+// (a metadata database Fermilab uses to organise large volumes of data and simulation files).
+// RunAllSamples.sh reads this list too, so keep one sample per line.
+const std::map<std::string, std::string> kSamples = {
+  {"NDGAR_FHC", "/pnfs/dune/persistent/users/marshalc/CAF/CAFv5gas/CAF_FHC_90*.root"}, // ND-GAr FHC
+  {"NDGAR_RHC", "/pnfs/dune/persistent/users/marshalc/CAF/CAFv5gas/CAF_RHC_90*.root"}, // ND-GAr RHC
+  {"NDLAR_FHC", "/pnfs/dune/persistent/users/marshalc/CAF/CAFv5/00/CAF_FHC_90*.root"}, // ND-LAr FHC
+  {"NDLAR_RHC", "/pnfs/dune/persistent/users/marshalc/CAF/CAFv5/00/CAF_RHC_90*.root"}  // ND-LAr RHC
+};
+
+// The name of the sample to run over: whatever the SAMPLE environment variable
+// says if it's set (e.g. SAMPLE=NDLAR_RHC cafe -bq Exercise1Solution.C), otherwise def.
+// RunAllSamples.sh uses this to run the same macro over all four samples.
+inline std::string SampleName(const std::string& def)
+{
+  const char* env = getenv("SAMPLE");
+  return (env && *env) ? env : def;
+}
+
+// The files for a sample. If the name isn't one of the samples, it's used as a
+// wildcard itself, so SAMPLE="synthetic_CAF_FHC_*.root" works too.
+inline std::string SampleWildcard(const std::string& sample,
+                                  const std::map<std::string, std::string>& samples = kSamples)
+{
+  auto it = samples.find(sample);
+  return it == samples.end() ? sample : it->second;
+}
+
+// A version of the sample name that's safe to put in an output file name
+inline std::string SampleLabel(const std::string& sample)
+{
+  std::string label;
+  for(char c: sample) label += isalnum(c) ? c : '_';
+  return label;
+}
+
+// A Spectrum and the name to save it under
+typedef std::vector<std::pair<std::string, const ana::Spectrum*>> NamedSpectra;
+
+// Write the filled Spectrum objects to a ROOT file. Each one goes in its own
+// directory along with its POT, so it can be loaded back later with
+// Spectrum::LoadFrom, or added up with the same spectra from other jobs
+// (see MergeSpectra.C and RunParallel.sh).
+inline void SaveSpectra(const std::string& fname, const NamedSpectra& specs)
+{
+  TFile fout(fname.c_str(), "RECREATE");
+  for(const auto& it: specs) it.second->SaveTo(&fout, it.first);
+  fout.Close();
+}
+
+// One category of a "split-by" axis: the value of an integer Var (like the
+// GENIE mode or LepPDG), and how to label and colour it when it's drawn
+struct SplitCategory
+{
+  int value;
+  std::string label;
+  Color_t color;
+};
+
+// A "split-by" axis: one bin per category, in the order they're listed.
+// Use it as the y axis of a 2D Spectrum: the loader then evaluates the Cut and
+// the split Var once per event and fills one histogram, instead of one Spectrum
+// (and one Cut) per category.
+// The Var gives the position of the event's value in cats (0, 1, 2...), so the
+// histogram has just as many bins as there are categories, however far apart
+// the values are. Events whose value isn't in the list go in the underflow.
+inline ana::HistAxis SplitAxis(const std::string& label, const ana::Var& var,
+                               const std::vector<SplitCategory>& cats)
+{
+  std::vector<int> values;
+  for(const SplitCategory& cat: cats) values.push_back(cat.value);
+  const ana::Var index([var, values](const caf::SRProxy* sr)
+                       {
+                         const int v = var(sr);
+                         for(size_t i = 0; i < values.size(); ++i) if(values[i] == v) return double(i);
+                         return -1.;
+                       });
+  return ana::HistAxis(label, ana::Binning::Simple(cats.size(), -.5, cats.size() - .5), index);
+}
+
+// Turn a Spectrum made with SplitAxis into a stack, with one filled
+// histogram per category. The first category goes at the bottom.
+// The histograms are also put in hists (in the same order) for the legend.
+inline THStack* SplitStack(const ana::Spectrum& s, double pot,
+                           const std::vector<SplitCategory>& cats,
+                           std::vector<TH1D*>& hists)
+{
+  TH2* h2 = s.ToTH2(pot);
+  THStack* stack = new THStack(ana::UniqueName().c_str(), "");
+  hists.clear();
+  for(size_t i = 0; i < cats.size(); ++i){
+    const SplitCategory& cat = cats[i];
+    TH1D* h = h2->ProjectionX(ana::UniqueName().c_str(), int(i) + 1, int(i) + 1); // Category i is in bin i+1
+    h->SetTitle(cat.label.c_str());
+    h->SetLineColor(cat.color);
+    h->SetFillColor(cat.color);
+    stack->Add(h);
+    hists.push_back(h);
+  }
+  stack->SetTitle((std::string(";") + h2->GetXaxis()->GetTitle()).c_str());
+  delete h2; // The projections are copies, so we're done with it
+  return stack;
+}
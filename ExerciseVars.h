@@ -0,0 +1,132 @@
+// The physical constants, Vars and Cuts the exercise solutions use.
+// They live here so that the solutions and Benchmark.C share one copy of each,
+// and the benchmark always times exactly what the solutions run.
+// The exercises themselves (Exercise1.C etc.) still have you write your own!
+
+#pragma once
+
+// These are standard header files from the CAFAna analysis tool
+#include "CAFAna/Core/Var.h"
+
+#include "StandardRecord/SRProxy.h" // A wrapper for the CAF format
+
+// Standard C++ library
+#include <cmath>
+
+/* *********
+ Define some physical constants
+ */
+const double M_P = .938; // Proton mass in GeV
+const double M_N = .939; // Neutron mass in GeV
+const double M_MU = .106; // Muon mass in GeV
+const double E_B = .028; // Binding energy for nucleons in argon-40 in GeV
+
+/*
+ Define some GENIE interaction modes.
+ See full list at https://wiki.dunescience.org/wiki/Scattering_mode
+ Use these to make your TRUTH cuts - this the interaction type GENIE simulated
+ */
+const int MODE_QE = 1;
+const int MODE_RES = 4;
+const int MODE_DIS = 3;
+const int MODE_MEC = 10;
+
+/*
+ Define some PDG codes (particle identifiers from https://pdg.lbl.gov/2007/reviews/montecarlorpp.pdf)
+ You can also find the ID's for things like protons, neutrons, pions and even whole nuclei in the list!
+ */
+const int PDG_MU=13;
+const int PDG_E=11;
+const int PDG_NUMU=14;
+const int PDG_NUE=12;
+
+// These parts of the QE formula don't depend on the muon, so work them out once
+// here rather than again for every event
+const double QE_NUM0 = M_P*M_P - (M_N - E_B)*(M_N - E_B) - M_MU*M_MU;
+const double QE_2MNB = 2 * (M_N - E_B);
+
+// The quasi-elastic formula for neutrino energy
+inline double QEFormula(double Emu, double cosmu) // Muon energy and cosine of muon angle
+{
+  //Muon momentum
+  const double pmu = sqrt(Emu*Emu - M_MU*M_MU); // Use the relativity formula E^2 = p^2 + m^2
+  // This is the neutrino-mode version of the formula. For antineutrino mode, swap neutron and proton masses (here and in QE_NUM0 and QE_2MNB).
+  const double num = QE_NUM0 + QE_2MNB * Emu;
+  const double denom = 2 * (M_N - E_B - Emu + pmu * cosmu);
+  return num/denom;
+}
+
+
+/* *********
+ Cuts
+ */
+
+// True QE interactions
+const ana::Cut kIsQE = SIMPLEVAR(mode) == MODE_QE;
+
+// The CCQE final state: 1 proton and 1 muon, no other particles
+const ana::Cut kHasQEFinalState([](const caf::SRProxy* sr)
+                                {
+                                  // This counts all the particles that aren't protons or muons: neutron, pi plus, pi minus, pi 0, positive kaon, negative kaon, neutral kaon, electromagnetic (gammas, electrons) and nuclear fragments. We want NONE of those!
+                                  const int totOthers = sr->nN + sr->nipip + sr->nipim + sr->nipi0 + sr->nikp + sr->nikm + sr->nik0 + sr->niem + sr->nNucleus;
+                                  // pass if the lepton is a mu- (PDG code 13), number of protons is 1, and total other particles is zero
+                                  return sr->LepPDG == PDG_MU && sr->nP == 1 && totOthers == 0;
+                                });
+
+// CC0pi: one negative muon, at least one proton, and no pions
+const ana::Cut kHasCC0PiFinalState([](const caf::SRProxy* sr)
+                                   {
+                                     const int totPi = sr->nipip + sr->nipim + sr->nipi0;
+                                     return sr->LepPDG == PDG_MU && sr->nP >= 1 && totPi == 0;
+                                   });
+
+// Events where the reconstructed neutrino energy and muon energy are both there
+// and above zero. Exercise 3 cuts the rest, to make the plot easier to interpret!
+const ana::Cut kHasRecoE([](const caf::SRProxy* sr)
+                         {
+                           if(std::isnan(sr->Ev_reco)) return false;
+                           if(sr->Ev_reco<=0.) return false;
+                           return sr->Elep_reco > 0.;
+                         });
+
+
+/* *********
+ Vars: the different ways of getting the neutrino energy in exercise 3
+ */
+
+// Conservation of energy from the true final-state particle energies
+const ana::Var kConservedETrue([](const caf::SRProxy* sr)
+                               {
+                                 const double Emu = sr->LepE; // LepE is (final-state) true lepton energy
+                                 const double protonKE=sr->eP; // kinetic energy
+                                 // Final energy (proton and muon) - other initial particles' energy (bound stationary neutron)
+                                 return Emu + (protonKE + M_P) - (M_N - E_B);
+                               });
+
+// Conservation of energy for the reconstructed final-state particle energies
+const ana::Var kConservedEReco([](const caf::SRProxy* sr)
+                               {
+                                 const double Emu = sr->Elep_reco; // Final-state reconstructed lepton (muon) energy
+                                 const double protonKE=sr->eRecoP; // kinetic energy
+                                 return Emu + (protonKE + M_P) - (M_N - E_B);
+                               });
+
+// Reconstructed energy reported by the CAF.
+const ana::Var kRecoE([](const caf::SRProxy* sr)
+                      {
+                        // As you know - if we can't understand the final state - we can't reconstruct neutrino energy!
+                        if(std::isnan(sr->Ev_reco)) return 0.; // This line just deals with records where the energy reconstruction didn't work
+                        return double(sr->Ev_reco);
+                      });
+
+// The quasi-elastic formula, from the reconstructed muon energy and angle
+const ana::Var kQEFormulaEnergy([](const caf::SRProxy* sr)
+                                {
+                                  const double Emu = sr->Elep_reco;
+                                  // Sometimes it can't reconstruct the muon at all!
+                                  // That's simulating a real detector where we sometimes won't be able to detect/identify a particle.
+                                  //In that case, we'll just return 0. (Check that before bothering to read the angle.)
+                                  if(Emu == 0) return 0.;
+                                  const double cosmu = cos(sr->theta_reco);
+                                  return QEFormula(Emu, cosmu);
+                                });
@@ -0,0 +1,72 @@
+# Reading input files ahead of a running cafe job, so that waiting for /pnfs
+# overlaps with processing. Used by RunAllSamples.sh and RunParallel.sh:
+#
+#   source Prefetch.sh
+#   prefetch $job_pid file1 file2 ... &
+#   prefetch_pid=$!
+#   ...
+#   stop_prefetch $prefetch_pid
+#
+# It only ever stays one file ahead of the job: the next file is read into the
+# page cache once the job has opened the one before it, so it doesn't fill up
+# the page cache (and push out the file the job is on) with the whole sample.
+# That only works for files the job opens through a mounted file system, such
+# as skims on local disk: files it reads over xrootd (which is how CAFAna
+# usually reads /pnfs) never show up as open, so nothing is read ahead of them.
+# It waits for the job to open its first file before reading anything, so in
+# that case it doesn't read any of them twice either.
+
+# The process and all its children, grandchildren...
+descendants()
+{
+  local pid
+  for pid in "$@"; do
+    echo "$pid"
+    descendants $(pgrep -P "$pid")
+  done
+}
+
+# Which of the files (given after the process ID, in order) the process has
+# open: prints the position in the list of the last one, or -1 for none
+last_open()
+{
+  local pid=$1; shift
+  local open=$(for p in $(descendants "$pid"); do
+                 for fd in /proc/$p/fd/*; do readlink -f "$fd"; done 2> /dev/null
+               done | sort -u)
+  local k last=-1
+  for ((k=0; k<$#; k++)); do
+    local f=$(readlink -f "${@:$((k+1)):1}")
+    grep -qxF -- "$f" <<< "$open" && last=$k
+  done
+  echo $last
+}
+
+# Read the files, in order, one ahead of the job with the given process ID.
+# Returns when the job finishes or all the files are read.
+prefetch()
+{
+  local pid=$1; shift
+  local next=1
+  while [ $next -lt $# ] && kill -0 "$pid" 2> /dev/null; do
+    local last=$(last_open "$pid" "$@")
+    if [ $last -ge 0 ] && [ $next -le $(( last + 1 )) ]; then
+      cat "${@:$((next+1)):1}" > /dev/null 2>&1 || true
+      next=$((next+1))
+    else
+      sleep 1
+    fi
+  done
+}
+
+# Stop a prefetch, along with the cat it may be in the middle of
+stop_prefetch()
+{
+  local pid children
+  for pid in "$@"; do
+    # Find the children first: once their parent is gone, pkill -P can't find them
+    children=$(descendants "$pid")
+    kill $children 2> /dev/null || true
+  done
+  return 0
+}
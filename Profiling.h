@@ -0,0 +1,273 @@
+// Optional timing of Vars and Cuts, to find out what makes an analysis slow.
+// You don't need to look in here to do the exercises!
+//
+// It's switched off unless you set EXERCISE_PROFILE to the name of a JSON file:
+//   EXERCISE_PROFILE=profile.json cafe -bq Exercise3Solution.C
+// Then wrap the Vars and Cuts you're interested in when you define them,
+//   const Cut kMyCut = ProfiledCut("kMyCut", Cut(...));
+// and call ProfileGo(loader, wildcard) instead of loader.Go(). At the end you
+// get a table of how often each Var and Cut was called and how long it took,
+// how many events each Cut passed (the "cut flow" - wrap each step of a
+// chain like kA && kB separately to see where the events go), and events/s
+// and bytes read for the whole loop and for each file. The same numbers are
+// written to the JSON file.
+// When it's switched off, ProfiledCut and ProfiledVar hand back the Cut or Var
+// you gave them, so there's no cost at all.
+
+#pragma once
+
+// These are standard header files from the CAFAna analysis tool
+#include "CAFAna/Core/SpectrumLoader.h"
+#include "CAFAna/Core/Spectrum.h"
+#include "CAFAna/Core/Binning.h"
+#include "CAFAna/Core/HistAxis.h"
+#include "CAFAna/Core/Var.h"
+
+#include "StandardRecord/SRProxy.h" // A wrapper for the CAF format
+
+// These files come from the ROOT data analysis package
+#include "TFile.h" // Keeps count of the bytes read from all files
+
+// Standard C++ library
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Timing and pass counts for one named Var or Cut
+struct ProfileStats
+{
+  std::string name;
+  bool isCut = false;
+  long calls = 0;
+  long pass = 0; // Only for Cuts
+  double totNs = 0;
+  // Calls binned by the time they took, for the percentiles. Each power of 2
+  // is split into kSubBins bins, so a percentile is good to within about 6%.
+  static const int kSubBins = 8;
+  long nsHist[64 * kSubBins] = {0};
+
+  void Add(long ns)
+  {
+    ++calls;
+    totNs += ns;
+    if(ns <= 0){
+      ++nsHist[0];
+      return;
+    }
+    // The highest bit set says which power of 2, the next 3 bits which eighth of it
+    const int msb = 63 - __builtin_clzl(ns);
+    const int sub = (msb >= 3 ? ns >> (msb - 3) : ns << (3 - msb)) & (kSubBins - 1);
+    ++nsHist[msb * kSubBins + sub];
+  }
+
+  // Approximate: the middle of the bin the percentile falls in
+  double PercentileNs(double frac) const
+  {
+    long seen = 0;
+    for(int bin = 0; bin < 64 * kSubBins; ++bin){
+      seen += nsHist[bin];
+      if(seen >= frac * calls){
+        const int msb = bin / kSubBins, sub = bin % kSubBins;
+        return std::ldexp(1 + (sub + .5) / kSubBins, msb);
+      }
+    }
+    return 0;
+  }
+};
+
+// Everything being profiled in this job
+inline std::vector<std::unique_ptr<ProfileStats>>& ProfileRegistry()
+{
+  static std::vector<std::unique_ptr<ProfileStats>> registry;
+  return registry;
+}
+
+// Where to write the JSON, or empty if profiling is switched off
+inline std::string ProfileFile()
+{
+  const char* env = getenv("EXERCISE_PROFILE");
+  return env ? env : "";
+}
+
+inline ProfileStats* RegisterProfile(const std::string& name, bool isCut)
+{
+  ProfileRegistry().emplace_back(new ProfileStats);
+  ProfileStats* stats = ProfileRegistry().back().get();
+  stats->name = name;
+  stats->isCut = isCut;
+  return stats;
+}
+
+inline long ProfileNsSince(std::chrono::steady_clock::time_point t0)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Time every call of a Cut and count how many events pass it
+inline ana::Cut ProfiledCut(const std::string& name, const ana::Cut& cut)
+{
+  if(ProfileFile().empty()) return cut;
+  ProfileStats* stats = RegisterProfile(name, true);
+  return ana::Cut([cut, stats](const caf::SRProxy* sr)
+                  {
+                    const auto t0 = std::chrono::steady_clock::now();
+                    const bool pass = cut(sr);
+                    stats->Add(ProfileNsSince(t0));
+                    stats->pass += pass;
+                    return pass;
+                  });
+}
+
+// Time every call of a Var
+inline ana::Var ProfiledVar(const std::string& name, const ana::Var& var)
+{
+  if(ProfileFile().empty()) return var;
+  ProfileStats* stats = RegisterProfile(name, false);
+  return ana::Var([var, stats](const caf::SRProxy* sr)
+                  {
+                    const auto t0 = std::chrono::steady_clock::now();
+                    const double val = var(sr);
+                    stats->Add(ProfileNsSince(t0));
+                    return val;
+                  });
+}
+
+// A string with the characters that would break it in a JSON file escaped
+inline std::string JsonEscape(const std::string& str)
+{
+  std::string out;
+  for(char c: str){
+    if(c == '"' || c == '\\') out += std::string("\\") + c;
+    else if(c == '\n') out += "\\n";
+    else if(c == '\t') out += "\\t";
+    else if((unsigned char)c < 0x20){
+      char hex[8];
+      snprintf(hex, sizeof(hex), "\\u%04x", c);
+      out += hex;
+    }
+    else out += c;
+  }
+  return out;
+}
+
+// The bytes the loader read from one input file
+struct ProfileFileStats
+{
+  std::string name;
+  double bytesRead = 0;
+};
+
+// Use this instead of loader.Go(). If profiling is on, it also times the whole
+// loop, counts the bytes read, and prints and saves everything at the end.
+inline void ProfileGo(ana::SpectrumLoader& loader, const std::string& wildcard)
+{
+  const std::string fname = ProfileFile();
+  if(fname.empty()){
+    loader.Go();
+    return;
+  }
+
+  // Count the records the loader really goes through (so cafe's --stride,
+  // --offset and -l are taken into account), with a Cut that passes everything
+  // on a Spectrum of its own. The loader's file is the current one while it
+  // runs the Cuts, so that also tells us when it moves on to the next file,
+  // and roughly how many bytes it read from each one. (Opening a file reads a
+  // little before its first record gets here, which is counted in the file
+  // before.)
+  const Long64_t bytesBefore = TFile::GetFileBytesRead();
+  long nRecords = 0;
+  std::vector<ProfileFileStats> files;
+  TFile* curFile = 0;
+  Long64_t fileBytesStart = bytesBefore;
+  const ana::Cut kCountRecords([&](const caf::SRProxy*)
+                               {
+                                 ++nRecords;
+                                 if(gFile != curFile){
+                                   const Long64_t now = TFile::GetFileBytesRead();
+                                   if(!files.empty()){
+                                     files.back().bytesRead = now - fileBytesStart;
+                                     fileBytesStart = now;
+                                   }
+                                   curFile = gFile;
+                                   files.push_back({gFile ? gFile->GetName() : "", 0});
+                                 }
+                                 return true;
+                               });
+  const ana::Var kZero([](const caf::SRProxy*){return 0.;});
+  ana::Spectrum counter(loader, ana::HistAxis("", ana::Binning::Simple(1, -1, 1), kZero), kCountRecords);
+
+  const auto t0 = std::chrono::steady_clock::now();
+  loader.Go();
+  const double totNs = ProfileNsSince(t0);
+  const Long64_t bytesAfter = TFile::GetFileBytesRead();
+  const double bytesRead = bytesAfter - bytesBefore;
+  if(!files.empty()) files.back().bytesRead = bytesAfter - fileBytesStart;
+  const int nFiles = files.size();
+
+  // Whatever time isn't spent in the profiled Vars and Cuts is the loader
+  // itself: reading files, and the Vars and Cuts you didn't wrap
+  double lambdaNs = 0;
+  for(const auto& s: ProfileRegistry()) lambdaNs += s->totNs;
+
+  printf("\n%-24s %4s %12s %12s %10s %10s %10s %10s %12s\n",
+         "Profile", "", "Calls", "Total (ms)", "Mean (ns)", "p50 (ns)", "p90 (ns)", "p99 (ns)", "Passed");
+  for(const auto& s: ProfileRegistry()){
+    printf("%-24s %4s %12ld %12.1f %10.1f %10.0f %10.0f %10.0f",
+           s->name.c_str(), s->isCut ? "Cut" : "Var", s->calls, s->totNs / 1e6,
+           s->calls ? s->totNs / s->calls : 0., s->PercentileNs(.5), s->PercentileNs(.9), s->PercentileNs(.99));
+    if(s->isCut) printf(" %12ld (%.1f%%)", s->pass, s->calls ? 100. * s->pass / s->calls : 0.);
+    printf("\n");
+  }
+  printf("%-24s %4s %12s %12.1f\n", "Everything else", "", "", (totNs - lambdaNs) / 1e6);
+  printf("%ld records from %d files in %.2f s: %.0f events/s, %.1f MB read (%.1f MB per file)\n",
+         nRecords, nFiles, totNs / 1e9, nRecords / (totNs / 1e9),
+         bytesRead / 1e6, nFiles ? bytesRead / 1e6 / nFiles : 0.);
+
+  // The cut flow: how many of all the records got to each Cut, and how many passed it.
+  // In a chain like kA && kB, kB only sees the events that passed kA.
+  printf("\n%-24s %12s %8s %12s %8s\n", "Cut flow", "Seen", "", "Passed", "");
+  printf("%-24s %12ld %7.1f%%\n", "All records", nRecords, 100.);
+  for(const auto& s: ProfileRegistry()){
+    if(!s->isCut) continue;
+    printf("%-24s %12ld %7.1f%% %12ld %7.1f%%\n", s->name.c_str(),
+           s->calls, nRecords ? 100. * s->calls / nRecords : 0.,
+           s->pass, nRecords ? 100. * s->pass / nRecords : 0.);
+  }
+
+  printf("\n%-60s %12s\n", "File", "MB read");
+  for(const ProfileFileStats& file: files) printf("%-60s %12.1f\n", file.name.c_str(), file.bytesRead / 1e6);
+  printf("\n");
+
+  FILE* f = fopen(fname.c_str(), "w");
+  if(!f){
+    fprintf(stderr, "Couldn't write profile to %s\n", fname.c_str());
+    return;
+  }
+  fprintf(f, "{\n  \"wildcard\": \"%s\",\n", JsonEscape(wildcard).c_str());
+  fprintf(f, "  \"records\": %ld,\n  \"files\": %d,\n", nRecords, nFiles);
+  fprintf(f, "  \"seconds\": %g,\n  \"events_per_second\": %g,\n", totNs / 1e9, nRecords / (totNs / 1e9));
+  fprintf(f, "  \"bytes_read\": %.0f,\n  \"bytes_read_per_file\": %.0f,\n", bytesRead, nFiles ? bytesRead / nFiles : 0.);
+  fprintf(f, "  \"file_bytes_read\": [");
+  for(size_t i = 0; i < files.size(); ++i){
+    fprintf(f, "%s\n    {\"name\": \"%s\", \"bytes_read\": %.0f}",
+            i ? "," : "", JsonEscape(files[i].name).c_str(), files[i].bytesRead);
+  }
+  fprintf(f, "\n  ],\n");
+  fprintf(f, "  \"other_ns\": %.0f,\n  \"profiles\": [", totNs - lambdaNs);
+  for(size_t i = 0; i < ProfileRegistry().size(); ++i){
+    const ProfileStats& s = *ProfileRegistry()[i];
+    fprintf(f, "%s\n    {\"name\": \"%s\", \"type\": \"%s\", \"calls\": %ld, \"total_ns\": %.0f, "
+               "\"p50_ns\": %.0f, \"p90_ns\": %.0f, \"p99_ns\": %.0f",
+            i ? "," : "", JsonEscape(s.name).c_str(), s.isCut ? "cut" : "var", s.calls, s.totNs,
+            s.PercentileNs(.5), s.PercentileNs(.9), s.PercentileNs(.99));
+    if(s.isCut) fprintf(f, ", \"passed\": %ld, \"failed\": %ld", s.pass, s.calls - s.pass);
+    fprintf(f, "}");
+  }
+  fprintf(f, "\n  ]\n}\n");
+  fclose(f);
+  printf("Profile written to %s\n", fname.c_str());
+}
@@ -0,0 +1,109 @@
+// The QE formula for a whole batch of muons at once, for when all the muon
+// energies and angles are already in memory (see RunQEFormula() in Benchmark.C).
+// It works out the same thing as kQEFormulaEnergy in ExerciseVars.h: 0 when
+// Emu is 0, NaN when Emu is below the muon mass, and QEFormula() otherwise.
+// You don't need to look in here to do the exercises!
+
+#pragma once
+
+#include "ExerciseVars.h" // QEFormula() and the constants it uses
+
+// Standard C++ library
+#include <string>
+
+// Vector instructions
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+// One muon at a time. This also does whatever's left over after the vector loops.
+inline void QEFormulaScalar(const double* Emu, const double* cosmu, double* out, int first, int n)
+{
+  for(int i = first; i < n; ++i) out[i] = Emu[i] == 0 ? 0. : QEFormula(Emu[i], cosmu[i]);
+}
+
+#if defined(__x86_64__)
+// The same arithmetic on 2 (SSE2), 4 (AVX) or 8 (AVX-512) muons per instruction.
+// The compiler can't do this by itself for the loop in QEFormulaScalar: sqrt()
+// may set errno, which means a branch in the loop, and ACLiC doesn't pass the
+// -fno-math-errno that would stop it. So these spell the instructions out.
+// Each operation is done in the same order as in QEFormula(), and the compiler
+// is told never to fuse a multiply and an add in any of them (AVX-512 has fused
+// multiply-adds, so it would otherwise use them there, and only there). So with
+// ACLiC's default flags they all give exactly the same answers as QEFormula().
+// If QEFormula() itself is compiled with fused multiply-adds (e.g. -mfma or
+// -march=native), all three differ from it in the last bits, in the same way.
+// Benchmark.C reports how many answers differ, and by how much.
+// Each one returns how many muons it did; QEFormulaScalar() does the rest.
+__attribute__((optimize("fp-contract=off")))
+inline int QEFormulaSSE2(const double* Emu, const double* cosmu, double* out, int n)
+{
+  const __m128d mmu2 = _mm_set1_pd(M_MU*M_MU), num0 = _mm_set1_pd(QE_NUM0);
+  const __m128d twoMNB = _mm_set1_pd(QE_2MNB), mnb = _mm_set1_pd(M_N - E_B);
+  const __m128d two = _mm_set1_pd(2), zero = _mm_setzero_pd();
+  int i = 0;
+  for(; i + 2 <= n; i += 2){
+    const __m128d e = _mm_loadu_pd(Emu + i);
+    const __m128d pmu = _mm_sqrt_pd(_mm_sub_pd(_mm_mul_pd(e, e), mmu2));
+    const __m128d num = _mm_add_pd(num0, _mm_mul_pd(twoMNB, e));
+    const __m128d denom = _mm_mul_pd(two, _mm_add_pd(_mm_sub_pd(mnb, e), _mm_mul_pd(pmu, _mm_loadu_pd(cosmu + i))));
+    // 0 where Emu == 0, the formula everywhere else
+    _mm_storeu_pd(out + i, _mm_andnot_pd(_mm_cmpeq_pd(e, zero), _mm_div_pd(num, denom)));
+  }
+  return i;
+}
+
+__attribute__((target("avx"), optimize("fp-contract=off")))
+inline int QEFormulaAVX(const double* Emu, const double* cosmu, double* out, int n)
+{
+  const __m256d mmu2 = _mm256_set1_pd(M_MU*M_MU), num0 = _mm256_set1_pd(QE_NUM0);
+  const __m256d twoMNB = _mm256_set1_pd(QE_2MNB), mnb = _mm256_set1_pd(M_N - E_B);
+  const __m256d two = _mm256_set1_pd(2), zero = _mm256_setzero_pd();
+  int i = 0;
+  for(; i + 4 <= n; i += 4){
+    const __m256d e = _mm256_loadu_pd(Emu + i);
+    const __m256d pmu = _mm256_sqrt_pd(_mm256_sub_pd(_mm256_mul_pd(e, e), mmu2));
+    const __m256d num = _mm256_add_pd(num0, _mm256_mul_pd(twoMNB, e));
+    const __m256d denom = _mm256_mul_pd(two, _mm256_add_pd(_mm256_sub_pd(mnb, e), _mm256_mul_pd(pmu, _mm256_loadu_pd(cosmu + i))));
+    _mm256_storeu_pd(out + i, _mm256_andnot_pd(_mm256_cmp_pd(e, zero, _CMP_EQ_OQ), _mm256_div_pd(num, denom)));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+inline int QEFormulaAVX512(const double* Emu, const double* cosmu, double* out, int n)
+{
+  const __m512d mmu2 = _mm512_set1_pd(M_MU*M_MU), num0 = _mm512_set1_pd(QE_NUM0);
+  const __m512d twoMNB = _mm512_set1_pd(QE_2MNB), mnb = _mm512_set1_pd(M_N - E_B);
+  const __m512d two = _mm512_set1_pd(2), zero = _mm512_setzero_pd();
+  int i = 0;
+  for(; i + 8 <= n; i += 8){
+    const __m512d e = _mm512_loadu_pd(Emu + i);
+    // (The masked sqrt is the same as _mm512_sqrt_pd, which makes GCC 12 warn about an uninitialised value)
+    const __m512d pmu = _mm512_maskz_sqrt_pd(0xFF, _mm512_sub_pd(_mm512_mul_pd(e, e), mmu2));
+    const __m512d num = _mm512_add_pd(num0, _mm512_mul_pd(twoMNB, e));
+    const __m512d denom = _mm512_mul_pd(two, _mm512_add_pd(_mm512_sub_pd(mnb, e), _mm512_mul_pd(pmu, _mm512_loadu_pd(cosmu + i))));
+    _mm512_storeu_pd(out + i, _mm512_maskz_div_pd(_mm512_cmp_pd_mask(e, zero, _CMP_NEQ_UQ), num, denom));
+  }
+  return i;
+}
+#endif
+
+// Works out the QE formula for n muons, using the widest vector instructions
+// this machine has. Ask for a particular version with simd = "avx512", "avx",
+// "sse2" or "scalar" (which is what any machine that isn't x86 gets).
+inline void QEFormula(const double* Emu, const double* cosmu, double* out, int n,
+                      const std::string& simd = "")
+{
+  int done = 0;
+#if defined(__x86_64__)
+  if(simd == "avx512" || (simd.empty() && __builtin_cpu_supports("avx512f")))
+    done = QEFormulaAVX512(Emu, cosmu, out, n);
+  else if(simd == "avx" || (simd.empty() && __builtin_cpu_supports("avx")))
+    done = QEFormulaAVX(Emu, cosmu, out, n);
+  else if(simd != "scalar")
+    done = QEFormulaSSE2(Emu, cosmu, out, n);
+#endif
+  QEFormulaScalar(Emu, cosmu, out, done, n);
+}
@@ -0,0 +1,72 @@
+#!/bin/bash
+# Run one of the exercise solutions over all four samples at once.
+#
+# Usage: ./RunAllSamples.sh Exercise1Solution.C [max jobs at once]
+#
+# You get one plot and one ROOT file of spectra per sample,
+# e.g. Exercise1_NDGAR_RHC.png and Exercise1_NDGAR_RHC.root.
+# The samples run side by side, as separate cafe jobs, with at most the given
+# number (default: the number of cores) running at a time. While each job
+# works on one file, its next file is read in the background, so waiting
+# for the disk overlaps with processing. That only helps when the files are
+# mounted locally (e.g. skims): CAFAna reads /pnfs over xrootd, which
+# Prefetch.sh can't see, so for those only ROOT's own read-ahead within each
+# file (the .rootrc below) helps.
+# The samples are the ones listed in kSamples in ExerciseUtils.h.
+# To split a single sample over more cores, use RunParallel.sh.
+
+set -e
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 Macro.C [max jobs]"
+  exit 1
+fi
+
+macro=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+budget=${2:-$(nproc)}
+
+here=$(cd "$(dirname "$0")" && pwd)
+source "$here/Prefetch.sh"
+
+# The samples and their files, read from kSamples in ExerciseUtils.h, so
+# there's only one list to keep up to date
+declare -A samples
+names=()
+while read -r s wildcard; do
+  samples[$s]=$wildcard
+  names+=("$s")
+done < <(sed -n '/kSamples = {/,/^};/ s/^ *{"\([^"]*\)", *"\([^"]*\)"}.*/\1 \2/p' "$here/ExerciseUtils.h")
+if [ ${#names[@]} -eq 0 ]; then
+  echo "Couldn't find the samples in $here/ExerciseUtils.h"
+  exit 1
+fi
+
+runSample()
+{
+  local s=$1
+  local dir=$PWD/run_$s
+  mkdir -p "$dir"
+  # Have ROOT read ahead within each file on a background thread while the loader works
+  echo "TFile.AsyncPrefetching: 1" > "$dir/.rootrc"
+
+  (cd "$dir" && SAMPLE=$s exec cafe -bq "$macro" > log.txt 2>&1) &
+  local job=$!
+
+  # Read the files in the background, one ahead of the loader (see Prefetch.sh)
+  prefetch $job ${samples[$s]} &
+  local prefetch_pid=$!
+
+  wait $job || echo "$s failed - see $dir/log.txt"
+  stop_prefetch $prefetch_pid
+
+  # Bring the plot and spectra back here - they have the sample in their names
+  mv "$dir"/*_$s.png "$dir"/*_$s.root . 2> /dev/null || true
+  echo "Finished $s"
+}
+
+for s in "${names[@]}"; do
+  # Wait for a free slot
+  while [ "$(jobs -rp | wc -l)" -ge "$budget" ]; do wait -n; done
+  runSample $s &
+done
+wait
@@ -0,0 +1,103 @@
+#!/bin/bash
+# Run one of the exercise macros on lots of cores at once.
+#
+# Usage: ./RunParallel.sh Exercise1Solution.C [number of jobs]
+#
+# Each job uses cafe's --stride and --offset options to read a different
+# share of the input files, and saves its spectra in its own directory.
+# MergeSpectra.C then adds up their histograms, POT and livetime in a fixed
+# order. The merged spectra should match a single serial job's, although the
+# sums are done in a different order, so the last digits can differ.
+# Finally the macro is run once more with EXERCISE_SPECTRA_FROM pointing at
+# the merged file, which loads the spectra from it instead of filling them
+# (see SpectrumCache.h), so you get the plot for the whole sample.
+# If any job fails, or doesn't write all its files, nothing is merged.
+# The number of jobs defaults to the number of cores.
+#
+# Set SAMPLE to pick the sample (see SampleName() in ExerciseUtils.h).
+# Set PREFETCH_FILES to the same files (as a wildcard) and each job's next
+# file is read ahead in the background, so it's already in the page cache
+# by the time cafe opens it (see Prefetch.sh). That only helps for files on a
+# locally mounted disk, such as skims, not for /pnfs files read over xrootd.
+
+set -e
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 Macro.C [njobs]"
+  exit 1
+fi
+
+macro=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+njobs=${2:-$(nproc)}
+name=$(basename "$macro" .C)
+here=$(cd "$(dirname "$0")" && pwd)
+source "$here/Prefetch.sh"
+workdir=$PWD/parallel_$name${SAMPLE:+_$(echo "$SAMPLE" | tr -c "A-Za-z0-9\n" "_")}
+
+# Each job only reads its share of the files, so it mustn't use (or fill) the
+# spectrum cache, which is for spectra made from all of them
+export EXERCISE_NO_CACHE=1
+
+rm -rf "$workdir"
+for i in $(seq 0 $((njobs-1))); do
+  jobdir=$(printf "%s/job_%03d" "$workdir" "$i")
+  mkdir -p "$jobdir"
+  # Have ROOT read ahead within each file on a background thread while the loader works
+  echo "TFile.AsyncPrefetching: 1" > "$jobdir/.rootrc"
+  (cd "$jobdir" && exec cafe -bq --stride "$njobs" --offset "$i" "$macro" > log.txt 2>&1) &
+  job=$!
+  jobs_pids="$jobs_pids $job"
+
+  # Read the job's share of the files (the same ones --stride and --offset pick), one ahead of it
+  if [ -n "$PREFETCH_FILES" ]; then
+    files=( $PREFETCH_FILES )
+    share=()
+    for ((k=i; k<${#files[@]}; k+=njobs)); do share+=("${files[$k]}"); done
+    prefetch $job "${share[@]}" &
+    prefetch_pids="$prefetch_pids $!"
+  fi
+done
+
+# Wait for every job, not just the last one, and remember which ones failed
+failed=0
+for pid in $jobs_pids; do
+  wait "$pid" || failed=$((failed+1))
+done
+# Don't keep reading once the jobs are done
+stop_prefetch $prefetch_pids
+
+if [ $failed -gt 0 ]; then
+  echo "$failed of $njobs jobs failed - not merging. See $workdir/job_*/log.txt"
+  exit 1
+fi
+
+# Every job writes the same output file names, so find them from the first job...
+outputs=$(cd "$workdir/job_000" && ls *.root 2> /dev/null || true)
+if [ -z "$outputs" ]; then
+  echo "The jobs didn't write any spectra - nothing to merge. See $workdir/job_000/log.txt"
+  exit 1
+fi
+# ...and make sure every other job wrote them too
+for out in $outputs; do
+  for i in $(seq 0 $((njobs-1))); do
+    jobdir=$(printf "%s/job_%03d" "$workdir" "$i")
+    if [ ! -f "$jobdir/$out" ]; then
+      echo "$jobdir didn't write $out - not merging. See $jobdir/log.txt"
+      exit 1
+    fi
+  done
+done
+
+for out in $outputs; do
+  MERGE_INPUTS="$workdir/job_*/$out" MERGE_OUTPUT="$out" cafe -bq "$here/MergeSpectra.C"
+done
+
+# Each job only drew its own share, so draw the plot again from the merged spectra.
+# Only macros that get their spectra through CachedSpectra can do that.
+if grep -q CachedSpectra "$macro"; then
+  for out in $outputs; do
+    EXERCISE_SPECTRA_FROM="$PWD/$out" cafe -bq "$macro"
+  done
+else
+  echo "$(basename "$macro") doesn't use CachedSpectra, so the plot can't be redrawn from the merged spectra"
+fi
@@ -0,0 +1,287 @@
+// Keeps filled Spectrum objects on disk, so rerunning a macro when you've only
+// changed how the plot is drawn doesn't have to read all the CAF files again.
+// You don't need to look in here to do the exercises!
+//
+// Instead of making each Spectrum directly,
+//   Spectrum sTrueENumu(loader, axTrue, kIsNumuCC && !kIsAntiNu);
+// ask the cache for it, and call cache.Go() instead of loader.Go():
+//   CachedSpectra cache(loader, wildcard, __FILE__);
+//   Spectrum& sTrueENumu = cache.Get("sTrueENumu", axTrue, kIsNumuCC && !kIsAntiNu);
+//   cache.Go();
+// Spectra that are already in the cache are loaded (with their POT) straight
+// away; only the rest are filled by the loader, and then saved for next time.
+//
+// Each Spectrum is saved under a key made from:
+//  - the input files: their paths, sizes and modification times
+//  - the command line options and CAFANA_* environment variables, since cafe's
+//    --stride, --offset and -l change which records get read
+//  - its name, axis labels and binning
+//  - the text of your macro up to the "cache.Go();" line - that's where the Vars
+//    and Cuts are defined, so changing any of them (or anything else above
+//    cache.Go()) means the spectra get filled again. Changing the drawing code
+//    below it doesn't. If there's no such line, it's the whole macro.
+//  - the whole text of the headers your macro includes with #include "..."
+//    from the same directory (like ExerciseVars.h), and the ones they include.
+// Vars and Cuts that come from CAFAna itself (kTrueEnergy, kIsNumuCC...) are
+// NOT part of the key, so if you change or update CAFAna, delete the cache.
+// The cache lives in .spectrum_cache (or $EXERCISE_CACHE_DIR). Delete it to
+// start again, or set EXERCISE_NO_CACHE=1 to ignore it for one run. It's also
+// ignored when EXERCISE_PROFILE is set (see Profiling.h), since there'd be
+// nothing to profile if every Spectrum came from the cache.
+//
+// Set EXERCISE_SPECTRA_FROM to a file written by SaveSpectra() (or MergeSpectra.C)
+// to take every Spectrum from there instead, by name, without reading any CAF
+// files at all. RunParallel.sh uses that to draw the plot from the merged spectra.
+
+#pragma once
+
+// These are standard header files from the CAFAna analysis tool
+#include "CAFAna/Core/SpectrumLoader.h"
+#include "CAFAna/Core/Spectrum.h"
+#include "CAFAna/Core/Binning.h"
+#include "CAFAna/Core/HistAxis.h"
+#include "CAFAna/Core/Utilities.h" // For Wildcard()
+
+#include "Profiling.h" // For ProfileGo()
+
+// These files come from the ROOT data analysis package
+#include "TApplication.h" // The command line options
+#include "TFile.h" // A ROOT data file
+#include "TSystem.h" // File sizes, times, and making directories
+
+// Standard C++ library
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unistd.h> // For environ
+#include <vector>
+
+class CachedSpectra
+{
+public:
+  // sourceFile should be __FILE__, the macro the Vars and Cuts are defined in
+  CachedSpectra(ana::SpectrumLoader& loader, const std::string& wildcard,
+                const std::string& sourceFile)
+    : fLoader(loader), fWildcard(wildcard), fNHits(0)
+  {
+    const char* dir = getenv("EXERCISE_CACHE_DIR");
+    fDir = dir ? dir : ".spectrum_cache";
+
+    const char* from = getenv("EXERCISE_SPECTRA_FROM");
+    if(from) fFrom = from;
+
+    const char* off = getenv("EXERCISE_NO_CACHE");
+    fEnabled = fFrom.empty() && !(off && *off && std::string(off) != "0");
+    if(fEnabled) fEnabled = FilesID() && SourceID(sourceFile);
+    if(fEnabled) RunID(sourceFile);
+
+    if(fEnabled && !ProfileFile().empty()){
+      std::cout << "Profiling, so not using the spectrum cache: every Spectrum is filled from the files" << std::endl;
+      fEnabled = false;
+    }
+  }
+
+  // A 1D Spectrum, from the cache if it's there, otherwise one the loader will fill
+  ana::Spectrum& Get(const std::string& name, const ana::HistAxis& axis, const ana::Cut& cut)
+  {
+    return GetOrMake(name, {&axis}, [&](){return new ana::Spectrum(fLoader, axis, cut);});
+  }
+
+  // The same for a 2D Spectrum (e.g. one with a split-by axis, see SplitAxis())
+  ana::Spectrum& Get(const std::string& name, const ana::HistAxis& xAxis,
+                     const ana::HistAxis& yAxis, const ana::Cut& cut)
+  {
+    return GetOrMake(name, {&xAxis, &yAxis}, [&](){return new ana::Spectrum(fLoader, xAxis, yAxis, cut);});
+  }
+
+  // Fill whatever wasn't in the cache (if anything), and save it for next time
+  void Go()
+  {
+    if(fEnabled) std::cout << "Loaded " << fNHits << " of " << fSpectra.size() << " spectra from " << fDir << std::endl;
+    if(fMisses.empty()){
+      if(!fFrom.empty() && !ProfileFile().empty()) std::cout << "Every Spectrum came from " << fFrom << ", so there's no profile to write to " << ProfileFile() << std::endl;
+      return;
+    }
+
+    ProfileGo(fLoader, fWildcard);
+
+    if(!fEnabled) return;
+    gSystem->mkdir(fDir.c_str(), true);
+    for(const auto& miss: fMisses){
+      // Write to a temporary name first, so a crash never leaves half a file in the cache
+      const std::string path = CachePath(miss.second);
+      const std::string tmp = path + ".tmp" + std::to_string(gSystem->GetPid());
+      TFile fout(tmp.c_str(), "RECREATE");
+      fSpectra[miss.first]->SaveTo(&fout, "spec");
+      fout.Close();
+      gSystem->Rename(tmp.c_str(), path.c_str());
+    }
+  }
+
+protected:
+  ana::Spectrum& GetOrMake(const std::string& name,
+                           const std::vector<const ana::HistAxis*>& axes,
+                           const std::function<ana::Spectrum*()>& make)
+  {
+    if(fSpectra.count(name)){
+      std::cerr << "CachedSpectra: there's already a Spectrum called " << name << std::endl;
+      abort();
+    }
+
+    if(!fFrom.empty()){
+      TFile fin(fFrom.c_str());
+      if(fin.IsZombie() || !fin.GetDirectory(name.c_str())){
+        std::cerr << "CachedSpectra: no Spectrum called " << name << " in " << fFrom << std::endl;
+        abort();
+      }
+      fSpectra[name] = ana::Spectrum::LoadFrom(&fin, name);
+      return *fSpectra[name];
+    }
+
+    if(fEnabled){
+      const std::string key = Key(name, axes);
+      const std::string path = CachePath(key);
+      if(!gSystem->AccessPathName(path.c_str())){ // Returns false if the file *does* exist
+        TFile fin(path.c_str());
+        fSpectra[name] = ana::Spectrum::LoadFrom(&fin, "spec");
+        ++fNHits;
+        return *fSpectra[name];
+      }
+      fMisses.emplace_back(name, key);
+    }
+    else{
+      fMisses.emplace_back(name, "");
+    }
+    fSpectra[name].reset(make());
+    return *fSpectra[name];
+  }
+
+  // Identify the input files by path, size and modification time
+  bool FilesID()
+  {
+    const std::vector<std::string> fnames = ana::Wildcard(fWildcard);
+    if(fnames.empty()) return false; // Not files (a SAM dataset, maybe) - don't try to cache
+    std::ostringstream id;
+    for(const std::string& fname: fnames){
+      FileStat_t stat;
+      if(gSystem->GetPathInfo(fname.c_str(), stat) != 0) return false;
+      id << fname << " " << stat.fSize << " " << stat.fMtime << "\n";
+    }
+    fFilesID = id.str();
+    return true;
+  }
+
+  // Everything about how the job was started that could change which records
+  // get read: the command line (apart from the macro itself, and -b and -q,
+  // which only stop it drawing on the screen and make it quit at the end),
+  // and the CAFANA_* environment variables
+  void RunID(const std::string& sourceFile)
+  {
+    std::ostringstream id;
+    const std::string macro = gSystem->BaseName(sourceFile.c_str());
+    if(gApplication){
+      for(int i = 1; i < gApplication->Argc(); ++i){
+        const std::string arg = gApplication->Argv(i);
+        if(arg == "-b" || arg == "-q" || arg == "-bq" || arg == "-qb") continue;
+        if(arg.find(macro) != std::string::npos) continue; // The macro, maybe with a + or arguments
+        id << arg << "\n";
+      }
+    }
+    for(char** env = environ; *env; ++env){
+      if(std::string(*env).compare(0, 7, "CAFANA_") == 0) id << *env << "\n";
+    }
+    fRunID = id.str();
+  }
+
+  // The text of a file, or false if it can't be read
+  static bool ReadText(const std::string& fname, std::string& text)
+  {
+    std::ifstream fin(fname);
+    if(!fin) return false;
+    std::stringstream ss;
+    ss << fin.rdbuf();
+    text = ss.str();
+    return true;
+  }
+
+  // Add the text of each header that text includes with #include "...", and
+  // that's in dir, and of the headers they include, to fSourceID
+  void AddHeaders(const std::string& text, const std::string& dir, std::set<std::string>& seen)
+  {
+    std::istringstream lines(text);
+    std::string line;
+    while(std::getline(lines, line)){
+      const size_t inc = line.find("#include");
+      if(inc == std::string::npos || line.find_first_not_of(" \t") != inc) continue;
+      const size_t open = line.find('"', inc);
+      const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+      if(close == std::string::npos) continue;
+      const std::string path = dir + "/" + line.substr(open + 1, close - open - 1);
+      std::string header;
+      if(seen.count(path) || !ReadText(path, header)) continue; // CAFAna and ROOT headers aren't here
+      seen.insert(path);
+      fSourceID += "\n" + path + "\n" + header;
+      AddHeaders(header, dir, seen);
+    }
+  }
+
+  // The macro's text up to where it calls cache.Go(), and the headers it includes
+  bool SourceID(const std::string& sourceFile)
+  {
+    std::string text;
+    if(!ReadText(sourceFile, text)) return false;
+    // Look for the call itself, not the mentions of loader.Go() in comments
+    const size_t go = text.find("cache.Go();");
+    if(go != std::string::npos) text.resize(go);
+    fSourceID = text;
+    std::set<std::string> seen;
+    AddHeaders(text, gSystem->DirName(sourceFile.c_str()), seen);
+    return true;
+  }
+
+  std::string Key(const std::string& name, const std::vector<const ana::HistAxis*>& axes) const
+  {
+    std::ostringstream desc;
+    desc.precision(17);
+    desc << fFilesID << "\n" << fRunID << "\n" << fSourceID << "\n" << name << "\n";
+    for(const ana::HistAxis* axis: axes){
+      for(const std::string& label: axis->GetLabels()) desc << label << "\n";
+      for(const ana::Binning& bins: axis->GetBinnings()){
+        for(double edge: bins.Edges()) desc << edge << " ";
+        desc << "\n";
+      }
+    }
+
+    // 64-bit FNV-1a hash: simple, and the same every time on every machine
+    unsigned long long hash = 14695981039346656037ULL;
+    for(char c: desc.str()){
+      hash ^= (unsigned char)c;
+      hash *= 1099511628211ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", hash);
+    return hex;
+  }
+
+  std::string CachePath(const std::string& key) const {return fDir + "/" + key + ".root";}
+
+  ana::SpectrumLoader& fLoader;
+  std::string fWildcard;
+  std::string fDir;
+  std::string fFrom; // Load every Spectrum from this file instead, if it's set
+  bool fEnabled;
+  std::string fFilesID;
+  std::string fRunID;
+  std::string fSourceID;
+
+  std::map<std::string, std::unique_ptr<ana::Spectrum>> fSpectra;
+  std::vector<std::pair<std::string, std::string>> fMisses; // Name and key of each one to fill
+  int fNHits;
+};